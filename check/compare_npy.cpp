@@ -0,0 +1,82 @@
+// porovnání dvou exportů spektra (-f npy -q f32), použité v make check
+// vypíše největší odchylku magnitud v dB v zobrazovaném rozsahu (12 Np pod
+// maximem prvního souboru) a skončí chybou, pokud je větší než TOLERANCE
+//
+// použití: compare_npy REFERENCE.npy TESTOVANY.npy TOLERANCE_DB
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// načte pole float32 tvaru (rámce, biny), hlavičku zapisuje SpectrumWriter
+vector<float> readNpy(const string& filename, size_t& frames, size_t& bins){
+	ifstream in(filename, ios::binary);
+	char magic[8];
+	uint16_t length;
+	if(!in.read(magic, 8) || string(magic, 6) != "\x93NUMPY" || !in.read((char*)&length, 2))
+		throw runtime_error(filename + ": not a npy file");
+	string header(length, ' ');
+	in.read(&header[0], length);
+	if(header.find("'<f4'") == string::npos)
+		throw runtime_error(filename + ": expected float32 values");
+	size_t shape = header.find("'shape': (");
+	if(shape == string::npos)
+		throw runtime_error(filename + ": missing shape");
+	const char* p = header.c_str() + shape + 10;
+	char* end;
+	frames = strtoull(p, &end, 10);
+	bins = strtoull(end+1, nullptr, 10);
+
+	vector<float> values(frames*bins);
+	if(!in.read((char*)values.data(), values.size()*sizeof(float)))
+		throw runtime_error(filename + ": truncated data");
+	return values;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc != 4){
+		cerr << "usage: " << argv[0] << " REFERENCE.npy TESTED.npy TOLERANCE_DB" << endl;
+		return 2;
+	}
+
+	try {
+		size_t frames, bins, testedFrames, testedBins;
+		vector<float> reference = readNpy(argv[1], frames, bins);
+		vector<float> tested = readNpy(argv[2], testedFrames, testedBins);
+		double tolerance = atof(argv[3]);
+		if(frames != testedFrames || bins != testedBins){
+			cerr << argv[2] << ": shape differs from " << argv[1] << endl;
+			return 1;
+		}
+
+		double maxValue = 0;
+		for (float value : reference)
+			maxValue = max(maxValue, (double)value);
+		// stejný rozsah jako FFTRenderer, slabší biny se na obrázku nerozliší
+		double floor = maxValue*exp(-12.0);
+
+		double worst = 0;
+		for (size_t i = 0; i < reference.size(); ++i)
+		{
+			if(reference[i] < floor)
+				continue;
+			double deviation = fabs(20*log10(max((double)tested[i], 1e-30)/reference[i]));
+			worst = max(worst, deviation);
+		}
+
+		cout << argv[2] << ": max deviation " << worst << " dB" << endl;
+		return worst <= tolerance ? 0 : 1;
+	}
+	catch (exception& e) {
+		cerr << e.what() << endl;
+		return 2;
+	}
+}
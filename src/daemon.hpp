@@ -0,0 +1,203 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// démon přijímající úlohy přes unixový socket
+// protokol: klient pošle jeden řádek s argumenty jako na příkazové řádce,
+// oddělené tabulátorem (cesty tak mohou obsahovat mezery), a zavře zápis
+// (řádek musí dorazit do 5 s, jinak démon spojení zavře);
+// odpovědí je výpis úlohy zakončený řádkem "OK <ms> ms" nebo "ERROR <ms> ms"
+class RenderDaemon
+{
+public:
+	typedef function<int(const vector<string>&, ostream&)> Job;
+private:
+	string socketPath;
+	int workerCount;
+	Job job;
+
+	// spojení čekajících na workera, nad limit se odmítají (každé drží deskriptor)
+	static const size_t pendingPerWorker = 16;
+
+	mutex queueLock;
+	condition_variable queueReady;
+	queue<int> clients;
+
+	mutex logLock;
+
+	static bool readRequest(int fd, string& request){
+		// na celý požadavek má klient 5 s, jinak by nečinné spojení navždy blokovalo workera
+		const auto timeout = chrono::milliseconds(5000);
+		const size_t maxRequestSize = 64 << 10;
+		char chunk[4096];
+		auto deadline = chrono::steady_clock::now() + timeout;
+		while(request.find('\n') == string::npos){
+			int remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+			pollfd pfd = { fd, POLLIN, 0 };
+			if(remaining <= 0 || poll(&pfd, 1, remaining) <= 0)
+				return false;
+			ssize_t n = ::read(fd, chunk, sizeof(chunk));
+			if(n < 0)
+				return false;
+			if(n == 0)
+				break;
+			request.append(chunk, n);
+			if(request.size() > maxRequestSize)
+				return false;
+		}
+		request = request.substr(0, request.find('\n'));
+		return !request.empty();
+	}
+
+	static void writeAll(int fd, const string& data){
+		size_t written = 0;
+		while(written < data.size()){
+			ssize_t n = ::write(fd, data.data()+written, data.size()-written);
+			if(n <= 0)
+				return;
+			written += n;
+		}
+	}
+
+	static vector<string> split(const string& request){
+		vector<string> args;
+		stringstream ss(request);
+		string arg;
+		while(getline(ss, arg, '\t')){
+			if(!arg.empty())
+				args.push_back(arg);
+		}
+		return args;
+	}
+
+	void serve(int fd){
+		string request;
+		if(!readRequest(fd, request)){
+			::close(fd);
+			return;
+		}
+
+		auto start = chrono::steady_clock::now();
+		ostringstream log;
+		int status;
+		try {
+			status = job(split(request), log);
+		}
+		catch (const exception & e) {
+			log << e.what() << endl;
+			status = 1;
+		}
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		log << (status == 0 ? "OK " : "ERROR ") << ms << " ms" << endl;
+		writeAll(fd, log.str());
+		::close(fd);
+
+		lock_guard<mutex> guard(logLock);
+		cout << (status == 0 ? "ok    " : "chyba ") << ms << " ms\t" << request << endl;
+	}
+
+	void worker(){
+		while(true){
+			int fd;
+			{
+				unique_lock<mutex> guard(queueLock);
+				queueReady.wait(guard, [this](){ return !clients.empty(); });
+				fd = clients.front();
+				clients.pop();
+			}
+			serve(fd);
+		}
+	}
+
+public:
+	RenderDaemon(const string& socketPath, int workerCount, Job job) :
+		socketPath(socketPath), workerCount(max(1, workerCount)), job(job) {}
+
+	// běží, dokud není proces ukončen
+	void run(){
+		// klient může spojení zavřít dřív, než dostane odpověď
+		signal(SIGPIPE, SIG_IGN);
+
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if(socketPath.size() >= sizeof(address.sun_path))
+			throw invalid_argument("socket path too long");
+		strcpy(address.sun_path, socketPath.c_str());
+
+		int server = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(server < 0)
+			throw runtime_error("cannot create socket");
+		// socket z minulého běhu se smaže, jiný soubor se nepřepisuje
+		struct stat existing;
+		if(lstat(socketPath.c_str(), &existing) == 0){
+			if(!S_ISSOCK(existing.st_mode)){
+				::close(server);
+				throw runtime_error("socket path exists and is not a socket");
+			}
+			unlink(socketPath.c_str());
+		}
+		if(bind(server, (sockaddr*)&address, sizeof(address)) < 0 || listen(server, 128) < 0){
+			::close(server);
+			throw runtime_error("cannot listen on socket");
+		}
+
+		vector<thread> workers;
+		for (int i = 0; i < workerCount; ++i)
+			workers.emplace_back(&RenderDaemon::worker, this);
+
+		while(true){
+			int client = accept(server, nullptr, nullptr);
+			if(client < 0){
+				// např. EMFILE by se bez pauzy opakovalo v těsné smyčce
+				if(errno != EINTR)
+					this_thread::sleep_for(chrono::milliseconds(10));
+				continue;
+			}
+
+			bool accepted;
+			{
+				lock_guard<mutex> guard(queueLock);
+				accepted = clients.size() < pendingPerWorker*workerCount;
+				if(accepted){
+					clients.push(client);
+					queueReady.notify_one();
+				}
+			}
+			if(!accepted){
+				writeAll(client, "démon je přetížený\nERROR 0 ms\n");
+				// nepřečtený požadavek by místo odpovědi způsobil reset spojení
+				char chunk[4096];
+				while(recv(client, chunk, sizeof(chunk), MSG_DONTWAIT) > 0);
+				::close(client);
+				lock_guard<mutex> guard(logLock);
+				cout << "chyba 0 ms\t(odmítnuto, fronta je plná)" << endl;
+			}
+		}
+	}
+};
+
+#endif
@@ -4,12 +4,15 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include "sample_type.hpp"
 using namespace std;
 
 class FFT
 {
-    vector<double> cacher;
-    vector<double> cachei;
+    vector<sample_t> cacher;
+    vector<sample_t> cachei;
     int transformSize;
 public:
     void setTransformSize(int N){
@@ -26,17 +29,17 @@ public:
         }
     }
     // https://en.wikipedia.org/wiki/Cooley%E2%80%93Tukey_FFT_algorithm
-	void transform(vector<double>& data){
+	void transform(vector<sample_t>& data) const {
         int N = data.size()/2;
         if(N == 1) return;
 
         int imag = data.size()/2;
 
-        vector<double> even(N);
+        vector<sample_t> even(N);
         for (int i = 0; i < N; i++)
             even[i] = data[i*2];
 
-        vector<double> odd(N);
+        vector<sample_t> odd(N);
         for (int i = 0; i < N; i++)
             odd[i] = data[i*2+1];
 
@@ -46,17 +49,17 @@ public:
 
         for (int i = 0; i < N/2; ++i)
         {
-            double cr = cacher[i*transformSize/N];
-            double ci = cachei[i*transformSize/N];
+            sample_t cr = cacher[i*transformSize/N];
+            sample_t ci = cachei[i*transformSize/N];
             // sudé
-            double oddr = odd[i];
-            double oddi = odd[i+imag/2];
+            sample_t oddr = odd[i];
+            sample_t oddi = odd[i+imag/2];
             // liché
-            double evenr = even[i];
-            double eveni = even[i+imag/2];
+            sample_t evenr = even[i];
+            sample_t eveni = even[i+imag/2];
 
-            double tr = oddr*cr - oddi*ci;
-            double ti = oddr*ci + cr*oddi;
+            sample_t tr = oddr*cr - oddi*ci;
+            sample_t ti = oddr*ci + cr*oddi;
 
             data[i] = evenr + tr;
             data[i+imag] = eveni + ti;
@@ -66,10 +69,10 @@ public:
         }
 	}
 
-    vector<double> getMagnitudes(vector<double>& data){
+    vector<sample_t> getMagnitudes(vector<sample_t>& data) const {
         transform(data);
 
-        vector<double> magnitudes(data.size()/4);
+        vector<sample_t> magnitudes(data.size()/4);
         size_t N = data.size()/2;
         for (size_t i = 0; i < N/2; ++i)
         {
@@ -80,4 +83,109 @@ public:
     }
 };
 
+// FFT více rámců najednou ve structure-of-arrays uspořádání:
+// re[i*lanes + l] je i-tý sample l-tého rámce, každý motýlek je tak jedna
+// operace nad celým vektorem rámců bez přeskupování dat
+// iterativní radix-2 varianta se stejnými twiddle faktory jako FFT
+class BatchFFT
+{
+    // část řádku velikosti jednoho SIMD registru (vektorové rozšíření GCC);
+    // smyčku přes lanes kompilátor sám nevektorizuje kvůli krokům mezi řádky
+#if defined(__AVX512F__)
+    typedef sample_t vec_t __attribute__((vector_size(64)));
+#elif defined(__AVX__)
+    typedef sample_t vec_t __attribute__((vector_size(32)));
+#else
+    typedef sample_t vec_t __attribute__((vector_size(16)));
+#endif
+    static const int vecLanes = sizeof(vec_t)/sizeof(sample_t);
+
+    // řádky nemusí být zarovnané na velikost vektoru, memcpy se přeloží na nezarovnané load/store
+    static void load(vec_t& v, const sample_t* p){
+        memcpy(&v, p, sizeof(v));
+    }
+
+    static void store(sample_t* p, const vec_t& v){
+        memcpy(p, &v, sizeof(v));
+    }
+
+    vector<sample_t> cacher;
+    vector<sample_t> cachei;
+    vector<int> reversed;
+    int transformSize;
+public:
+    // počet rámců v dávce, 64 bajtů na řádek (16 float / 8 double)
+    static const int lanes = 64/sizeof(sample_t);
+
+    void setTransformSize(int N){
+        transformSize = N;
+        cacher.resize(N/2);
+        cachei.resize(N/2);
+        for (int i = 0; i < N/2; ++i)
+        {
+            cacher[i] = cos(-2*M_PI*i/N);
+            cachei[i] = sin(-2*M_PI*i/N);
+        }
+
+        int bits = 0;
+        while((1 << bits) < N)
+            bits++;
+        reversed.resize(N);
+        for (int i = 0; i < N; ++i)
+        {
+            int r = 0;
+            for (int b = 0; b < bits; ++b)
+                if(i & (1 << b))
+                    r |= 1 << (bits-1-b);
+            reversed[i] = r;
+        }
+    }
+
+    // re, im: transformSize*lanes hodnot
+    void transform(sample_t* re, sample_t* im) const {
+        const int N = transformSize;
+        for (int i = 0; i < N; ++i)
+        {
+            int r = reversed[i];
+            if(r > i){
+                swap_ranges(re+i*lanes, re+(i+1)*lanes, re+r*lanes);
+                swap_ranges(im+i*lanes, im+(i+1)*lanes, im+r*lanes);
+            }
+        }
+
+        for (int len = 2; len <= N; len *= 2)
+        {
+            int half = len/2;
+            int step = N/len;
+            for (int start = 0; start < N; start += len)
+            {
+                for (int j = 0; j < half; ++j)
+                {
+                    // rozkopírování do všech lanes (x - 0 zachová i znaménko nuly)
+                    const vec_t cr = cacher[j*step] - vec_t{};
+                    const vec_t ci = cachei[j*step] - vec_t{};
+                    sample_t* aRe = re + (start+j)*lanes;
+                    sample_t* aIm = im + (start+j)*lanes;
+                    sample_t* bRe = re + (start+j+half)*lanes;
+                    sample_t* bIm = im + (start+j+half)*lanes;
+                    for (int l = 0; l < lanes; l += vecLanes)
+                    {
+                        vec_t ar, ai, br, bi;
+                        load(ar, aRe+l);
+                        load(ai, aIm+l);
+                        load(br, bRe+l);
+                        load(bi, bIm+l);
+                        vec_t tr = br*cr - bi*ci;
+                        vec_t ti = br*ci + bi*cr;
+                        store(bRe+l, ar - tr);
+                        store(bIm+l, ai - ti);
+                        store(aRe+l, ar + tr);
+                        store(aIm+l, ai + ti);
+                    }
+                }
+            }
+        }
+    }
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,132 @@
+#ifndef FRAME_BLOCK_HPP
+#define FRAME_BLOCK_HPP
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "sample_type.hpp"
+#include "input.hpp"
+#include "spectrum_engine.hpp"
+
+using namespace std;
+
+// blok po sobě jdoucích rámců posuvného okna, které se zpracují najednou
+// (dávka pro BatchFFTEngine)
+struct FrameBlock
+{
+	enum Kind { COMPUTE, SILENT, DUPLICATE };
+
+	vector<vector<sample_t>> frames;
+	vector<Kind> kinds;
+	vector<shared_ptr<const vector<sample_t>>> columns;
+	int count = 0;
+
+	FrameBlock(int size, int windowSize) :
+		frames(size, vector<sample_t>(windowSize)), kinds(size), columns(size) {}
+
+	// načte až frames.size() rámců, false pokud už žádný nezbývá
+	bool read(SlidingWindow& sw){
+		count = 0;
+		while(count < (int)frames.size() && sw.read(frames[count], frames[count].size()))
+			count++;
+		return count > 0;
+	}
+};
+
+// rozdělení rámců na tiché (práh na součet čtverců), opakující se a ty, které je třeba spočítat
+class FrameClassifier
+{
+	double silenceEnergy;
+	vector<sample_t> previous;
+	bool hasPrevious = false;
+public:
+	int silentFrames = 0;
+	int duplicateFrames = 0;
+
+	// threshold je RMS v dBFS, -inf = pouze digitální nula
+	FrameClassifier(int windowSize, double threshold) : previous(windowSize) {
+		silenceEnergy = windowSize*pow(10.0, threshold/10.0);
+	}
+
+	// další rámec se s předchozím neporovná (rámce mimo pořadí, nový řetězec sloupců)
+	void reset(){
+		hasPrevious = false;
+	}
+
+	void classify(FrameBlock& block){
+		for (int f = 0; f < block.count; ++f)
+		{
+			const vector<sample_t>& frame = block.frames[f];
+			double energy = 0;
+			for (size_t i = 0; i < frame.size(); i++){
+				energy += frame[i]*frame[i];
+			}
+
+			const vector<sample_t>& last = f > 0 ? block.frames[f-1] : previous;
+			if(energy <= silenceEnergy){
+				block.kinds[f] = FrameBlock::SILENT;
+				silentFrames++;
+			}
+			else if((f > 0 || hasPrevious) && frame == last){
+				block.kinds[f] = FrameBlock::DUPLICATE;
+				duplicateFrames++;
+			}
+			else {
+				block.kinds[f] = FrameBlock::COMPUTE;
+			}
+		}
+		if(block.count > 0){
+			previous = block.frames[block.count-1];
+			hasPrevious = true;
+		}
+	}
+};
+
+// výpočet spekter bloku, tiché rámce dostanou sdílený nulový sloupec
+// opakující se rámce zůstanou prázdné, doplní je resolveDuplicates
+// všechny počítané rámce bloku jdou do enginu jednou dávkou, jen engine se stavem
+// (sliding DFT) dostává rámce po úsecích v pořadí
+inline void computeBlock(SpectrumEngine& engine, FrameBlock& block, const shared_ptr<const vector<sample_t>>& floorColumn){
+	vector<const vector<sample_t>*> pending;
+	vector<int> pendingIndex;
+	vector<vector<sample_t>> magnitudes;
+	auto computePending = [&](){
+		if(pending.empty())
+			return;
+		engine.getBatchMagnitudes(pending, magnitudes);
+		for (size_t i = 0; i < pending.size(); ++i)
+			block.columns[pendingIndex[i]] = make_shared<const vector<sample_t>>(move(magnitudes[i]));
+		pending.clear();
+		pendingIndex.clear();
+	};
+
+	for (int f = 0; f < block.count; ++f)
+	{
+		block.columns[f] = nullptr;
+		if(block.kinds[f] == FrameBlock::COMPUTE){
+			pending.push_back(&block.frames[f]);
+			pendingIndex.push_back(f);
+			continue;
+		}
+		if(block.kinds[f] == FrameBlock::SILENT)
+			block.columns[f] = floorColumn;
+
+		if(engine.needsOrderedSkip())
+			computePending();
+		engine.skip(block.frames[f]);
+	}
+	computePending();
+}
+
+// opakující se rámce převezmou sloupec předchozího rámce, bloky musí přicházet v pořadí
+inline void resolveDuplicates(FrameBlock& block, shared_ptr<const vector<sample_t>>& previousColumn){
+	for (int f = 0; f < block.count; ++f)
+	{
+		if(block.kinds[f] == FrameBlock::DUPLICATE)
+			block.columns[f] = previousColumn;
+		previousColumn = block.columns[f];
+	}
+}
+
+#endif
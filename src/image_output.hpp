@@ -6,6 +6,7 @@
 #include <memory>
 #include <algorithm>
 
+#include "sample_type.hpp"
 #include "window_functions.hpp"
 
 using namespace std;
@@ -70,9 +71,9 @@ class AveragesRenderer : public ImageBlock {
 	vector<double> spectrumSums;
 	int width = 100;
 public:
-	void addFrame(vector<double>& column){
+	void addFrame(const vector<sample_t>& column){
 		if(spectrumSums.size() == 0){
-			spectrumSums = column;
+			spectrumSums.assign(column.begin(), column.end());
 		}
 		else {
 			for (size_t i = 0; i < spectrumSums.size(); ++i)
@@ -115,11 +116,12 @@ public:
 };
 
 class FFTRenderer : public ImageBlock {
-	vector<vector<double>> spectrum;
+	// sloupce mohou být sdílené (tiché a opakující se rámce)
+	vector<shared_ptr<const vector<sample_t>>> spectrum;
 
 	// http://stackoverflow.com/questions/15868234/map-a-value-0-0-1-0-to-color-gain
 	// paleta z: http://4.bp.blogspot.com/-d96rd-cACn0/TdUINqcBxuI/AAAAAAAAA9I/nGDXL7ksxAc/s1600/01-Deep_Rumba-A_Calm_in_the_Fire_of_Dances_2496-Cubana.flac.png
-	double linear(double x, double start, double end) {
+	static double linear(double x, double start, double end) {
 		if (x < start)
 			return 0;
 		else if (x > end)
@@ -128,29 +130,36 @@ class FFTRenderer : public ImageBlock {
 			return (x-start) / (end-start);
 	}
 
-	double getR(double value){
+	static double getR(double value){
 		return linear(value, 25.0/200.0, 140.0/200.0);
 	}
-	double getG(double value){
+	static double getG(double value){
 		return linear(value, 120.0/200.0, 180.0/200.0);
 	}
-	double getB(double value){
+	static double getB(double value){
 		return linear(value, 0.75, 1.0) + (linear(value, 0, 57.0/200.0) - linear(value, 63.0/200.0, 120.0/200.0))*0.5;
 		return 1.0-linear(value, 0, 0.5);
 	}
 
-	vector<rgb_pixel> palette;
-public:
-	FFTRenderer(){
-		int paletteSize = 512;
-		double ps = paletteSize;
-		for (int i = 0; i < paletteSize; ++i)
-		{
-			rgb_pixel p(getR(i/ps)*255, getG(i/ps)*255, getB(i/ps)*255);
-			palette.push_back(p);
-		}
+	// paleta se počítá jen jednou a sdílí ji všechny instance (i mezi vlákny démona)
+	static const vector<rgb_pixel>& getPalette(){
+		static const vector<rgb_pixel> palette = [](){
+			vector<rgb_pixel> palette;
+			int paletteSize = 512;
+			double ps = paletteSize;
+			for (int i = 0; i < paletteSize; ++i)
+			{
+				rgb_pixel p(getR(i/ps)*255, getG(i/ps)*255, getB(i/ps)*255);
+				palette.push_back(p);
+			}
+			return palette;
+		}();
+		return palette;
 	}
-	void addFrame(vector<double> column){
+
+	const vector<rgb_pixel>& palette = getPalette();
+public:
+	void addFrame(shared_ptr<const vector<sample_t>> column){
 		spectrum.push_back(column);
 	}
 
@@ -167,7 +176,7 @@ public:
 			for (int y_ = 0; y_ < height; ++y_)
 			{
 
-				maxValue = max(maxValue, spectrum[x_][y_]);
+				maxValue = max(maxValue, (double)(*spectrum[x_])[y_]);
 			}
 		}
 
@@ -179,10 +188,11 @@ public:
 		{
 			for (int y_ = 0; y_ < height; ++y_)
 			{
-				double value = max(0.0, spectrum[x_][y_]/maxValue);
+				double value = max(0.0, (*spectrum[x_])[y_]/maxValue);
 				value = 1-min(-log(value), 12.0)/12.0;
 				value *= palette.size();
-				img[ty+height-y_][tx+x_] = palette[(size_t)value];
+				// maximum spektra (value == 1) patří do poslední barvy palety
+				img[ty+height-y_][tx+x_] = palette[min((size_t)value, palette.size()-1)];
 			}
 		}
 
@@ -210,36 +220,39 @@ public:
 	virtual int getHeight(){
 		if(spectrum.size() == 0)
 			return 0;
-		return spectrum[0].size();
+		return spectrum[0]->size();
 	};
 };
 
 class WaveRenderer : public ImageBlock {
-	vector<double> wave;
+	vector<sample_t> mins;
+	vector<sample_t> maxs;
 	int height = 100;
 public:
-	void addFrame(vector<double>& column, int slide){
-		slide = min(slide, (int)column.size());
-		double maxValue = *max_element(column.begin(), column.begin()+slide);
-		wave.push_back(maxValue);
+	void addPeak(sample_t minValue, sample_t maxValue){
+		mins.push_back(minValue);
+		maxs.push_back(maxValue);
 	}
 
 	virtual void render(image<rgb_pixel>& img, int tx, int ty){
-		if(wave.size() == 0)
+		if(maxs.size() == 0)
 			return;
 		tx += x;
 		ty += y;
 		ImageUtils::rectangle(img, tx, ty, getWidth(), getHeight());
 		double halfheight = 0.5*height;
-		for (size_t i = 0; i < wave.size(); ++i)
+		for (size_t i = 0; i < maxs.size(); ++i)
 		{
-			int size = halfheight*wave[i];
-			ImageUtils::vline(img, tx+x+i, ty+halfheight-size, size*2);
+			double top = max(-1.0, min(1.0, (double)maxs[i]));
+			double bottom = max(-1.0, min(1.0, (double)mins[i]));
+			int y0 = halfheight - halfheight*top;
+			int y1 = halfheight - halfheight*bottom;
+			ImageUtils::vline(img, tx+x+i, ty+y0, max(1, y1-y0));
 		}
 	}
 
 	virtual int getWidth(){
-		return wave.size();
+		return maxs.size();
 	};
 	virtual int getHeight(){
 		return height;
@@ -281,11 +294,11 @@ public:
 };
 
 class WindowRenderer : public ImageBlock {
-	unique_ptr<WindowFunction> windowf;
+	shared_ptr<const WindowFunction> windowf;
 	int windowSize;
 public:
 	double rangex, rangey, dx, dy;
-	WindowRenderer(int x, int y, int width, int height, unique_ptr<WindowFunction> windowf, int windowSize) : 
+	WindowRenderer(int x, int y, int width, int height, shared_ptr<const WindowFunction> windowf, int windowSize) : 
 		windowf(move(windowf)), windowSize(windowSize) {
 			this->x = x;
 			this->y = y;
@@ -300,7 +313,7 @@ public:
 
 		for (double x_ = 0; x_ <= width; ++x_)
 		{
-			double h = windowf->apply(height, x_*windowSize/width);
+			double h = windowf->apply(height, min((int)(x_*windowSize/width), windowSize-1));
 			ImageUtils::vline(img, tx+x_, ty+height-h+1, h);
 		}
 	}
@@ -2,6 +2,8 @@
 #define INPUT_HPP
 
 #include <vector>
+#include "sample_type.hpp"
+#include "waveform.hpp"
 using namespace std;
 
 class ChannelReader
@@ -9,14 +11,15 @@ class ChannelReader
 	int channels;
 	int channel;
 	SndfileHandle& handle;
-	vector<double> buffer;
+	vector<sample_t> buffer;
+	WaveformEnvelope* envelope = nullptr;
 public:
 	ChannelReader(SndfileHandle& handle_) : handle(handle_) {
 		channels = handle.channels();
 		setChannel(0);
 	}
 
-	int read(vector<double>& outBuffer, int size){
+	int read(vector<sample_t>& outBuffer, int size){
 		int bufferSize = size*channels;
 		buffer.resize(bufferSize);
 		int readBytes = handle.read(buffer.data(), bufferSize);
@@ -25,9 +28,21 @@ public:
 		{
 			outBuffer[i] = buffer[i*channels + channel];
 		}
+		// každý přečtený sample projde obálkou právě jednou
+		if(envelope)
+			envelope->addSamples(outBuffer.data(), readFrames);
 		return readFrames;
 	}
 
+	// přesun na zadaný frame souboru (náhodný přístup pro progresivní režim)
+	void seek(sf_count_t frame){
+		handle.seek(frame, SEEK_SET);
+	}
+
+	void setEnvelope(WaveformEnvelope* envelope_){
+		envelope = envelope_;
+	}
+
 	void setChannel(int channel_){
 		if(channel_ >= 0 && channel_ < channels)
 			channel = channel_;
@@ -44,11 +59,11 @@ class SlidingWindow
 	int windowSize;
 	int windowSlide;
 
-	vector<double> buffer;
-	vector<double> window;
+	vector<sample_t> buffer;
+	vector<sample_t> window;
 	ChannelReader& reader;
 
-	bool readTo(vector<double>& buf, int size){
+	bool readTo(vector<sample_t>& buf, int size){
 		int readBytes = reader.read(buf, size);
 		position += readBytes;
 		return readBytes == size;
@@ -83,7 +98,7 @@ class SlidingWindow
 	}
 
 public:
-	SlidingWindow(ChannelReader reader) : reader(reader) {
+	SlidingWindow(ChannelReader& reader) : reader(reader) {
 		setWindow(128, 64);
 	}
 
@@ -102,7 +117,7 @@ public:
 		window.resize(windowSize);
 	}
 
-	bool read(vector<double>& outBuffer, int size){
+	bool read(vector<sample_t>& outBuffer, int size){
 		if (next()) {
 			copy_n(window.begin(), size, outBuffer.begin());
 			return true;
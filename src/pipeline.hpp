@@ -0,0 +1,231 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sample_type.hpp"
+#include "input.hpp"
+#include "spectrum_engine.hpp"
+#include "frame_block.hpp"
+
+using namespace std;
+
+// ohraničená fronta pro jednoho producenta a jednoho konzumenta, bez zámků
+// v rychlé cestě
+// plná fronta zdrží producenta (backpressure), prázdná konzumenta; čekající
+// strana chvíli zkouší znovu a pak se uspí, aby nezabírala jádro FFT workerům
+template<class T>
+class SpscQueue
+{
+	static const int spinCount = 64;
+
+	vector<T> slots;
+	// indexy od sebe odděluje výplň velikosti cache line, aby se producent
+	// a konzument nepřetahovali; alignas(64) by se při alokaci přes new
+	// v C++14 nedodrželo
+	atomic<size_t> head{0}; // čte konzument
+	char headPadding[64 - sizeof(atomic<size_t>)];
+	atomic<size_t> tail{0}; // zapisuje producent
+	char tailPadding[64 - sizeof(atomic<size_t>)];
+
+	// uspání čekající strany, druhá strana ji po své operaci probudí
+	atomic<int> sleepers{0};
+	mutex sleepLock;
+	condition_variable wakeup;
+
+	void wakeSleepers(){
+		// čtení přes read-modify-write páruje s inkrementací v sleepUntil: buď tato
+		// strana uvidí spícího, nebo spící strana uvidí nové head/tail
+		if(sleepers.fetch_add(0) > 0){
+			lock_guard<mutex> guard(sleepLock);
+			wakeup.notify_all();
+		}
+	}
+
+	template<class Ready>
+	void sleepUntil(Ready ready){
+		unique_lock<mutex> guard(sleepLock);
+		sleepers.fetch_add(1);
+		wakeup.wait(guard, ready);
+		sleepers.fetch_sub(1);
+	}
+
+	bool canPush() const {
+		return (tail.load(memory_order_relaxed)+1) % slots.size() != head.load(memory_order_acquire);
+	}
+
+	bool canPop() const {
+		return head.load(memory_order_relaxed) != tail.load(memory_order_acquire);
+	}
+public:
+	explicit SpscQueue(size_t capacity) : slots(capacity+1) {}
+
+	bool tryPush(const T& value){
+		size_t t = tail.load(memory_order_relaxed);
+		size_t next = (t+1) % slots.size();
+		if(next == head.load(memory_order_acquire))
+			return false;
+		slots[t] = value;
+		tail.store(next, memory_order_release);
+		wakeSleepers();
+		return true;
+	}
+
+	bool tryPop(T& value){
+		size_t h = head.load(memory_order_relaxed);
+		if(h == tail.load(memory_order_acquire))
+			return false;
+		value = slots[h];
+		head.store((h+1) % slots.size(), memory_order_release);
+		wakeSleepers();
+		return true;
+	}
+
+	void push(const T& value){
+		for (int spin = 0; !tryPush(value); ++spin)
+		{
+			if(spin < spinCount)
+				this_thread::yield();
+			else
+				sleepUntil([this](){ return canPush(); });
+		}
+	}
+
+	T pop(){
+		T value;
+		for (int spin = 0; !tryPop(value); ++spin)
+		{
+			if(spin < spinCount)
+				this_thread::yield();
+			else
+				sleepUntil([this](){ return canPop(); });
+		}
+		return value;
+	}
+};
+
+// STFT rozdělené do vláken: dekodér (čtení, obálka, klasifikace rámců) ->
+// FFT workery -> sběrač (main vlákno, předání sloupců dál)
+// bloky rámců se recyklují, dekodér je rozděluje workerům dokola a sběrač je
+// ze stejného pořadí vybírá, takže sloupce vychází ve správném pořadí
+// a každá fronta má jediného producenta i konzumenta
+class StftPipeline
+{
+public:
+	typedef function<unique_ptr<SpectrumEngine>()> EngineFactory;
+	typedef function<void(const shared_ptr<const vector<sample_t>>&)> ColumnSink;
+private:
+	// bloků na jednoho workera ve frontách
+	static const int queueDepth = 4;
+	// strop pro samply ve všech blocích (64 MiB v double), u velkých rámců
+	// a mnoha jader se omezí počet bloků a tím i počet workerů
+	static const long maxQueuedSamples = 8 << 20;
+
+	SlidingWindow& sw;
+	FrameClassifier& classifier;
+	vector<unique_ptr<SpectrumEngine>> engines;
+	int windowSize;
+	int blockCount;
+	shared_ptr<const vector<sample_t>> floorColumn;
+public:
+	// engine se stavem (sliding DFT) musí běžet v jediném workeru
+	StftPipeline(SlidingWindow& sw, FrameClassifier& classifier, EngineFactory factory, int workers, int windowSize) :
+		sw(sw), classifier(classifier), windowSize(windowSize) {
+		engines.push_back(factory());
+		long blockSamples = (long)engines[0]->getBatchSize()*windowSize;
+		blockCount = max(1, workers)*queueDepth + 2;
+		blockCount = max(2L, min((long)blockCount, maxQueuedSamples/blockSamples));
+		// víc workerů, než je bloků, by nemělo co počítat
+		workers = min(max(1, workers), blockCount);
+		for (int i = 1; i < workers; ++i)
+			engines.push_back(factory());
+		floorColumn = make_shared<const vector<sample_t>>(windowSize/2, 0);
+	}
+
+	void run(ColumnSink sink){
+		int workers = engines.size();
+		int batchSize = engines[0]->getBatchSize();
+
+		vector<unique_ptr<FrameBlock>> blocks;
+		// prázdné bloky putují ze sběrače zpět do dekodéru
+		SpscQueue<FrameBlock*> freeBlocks(blockCount);
+		for (int i = 0; i < blockCount; ++i)
+		{
+			blocks.push_back(make_unique<FrameBlock>(batchSize, windowSize));
+			freeBlocks.push(blocks.back().get());
+		}
+
+		// nullptr značí konec vstupu
+		vector<unique_ptr<SpscQueue<FrameBlock*>>> input;
+		vector<unique_ptr<SpscQueue<FrameBlock*>>> output;
+		for (int i = 0; i < workers; ++i)
+		{
+			input.push_back(make_unique<SpscQueue<FrameBlock*>>(blockCount));
+			output.push_back(make_unique<SpscQueue<FrameBlock*>>(blockCount));
+		}
+
+		atomic<bool> stop{false};
+
+		thread decoder([&](){
+			for (size_t sequence = 0; !stop.load(memory_order_relaxed); ++sequence)
+			{
+				FrameBlock* block = freeBlocks.pop();
+				if(!block->read(sw))
+					break;
+				classifier.classify(*block);
+				input[sequence % workers]->push(block);
+			}
+			for (int i = 0; i < workers; ++i)
+				input[i]->push(nullptr);
+		});
+
+		vector<thread> fftWorkers;
+		for (int i = 0; i < workers; ++i)
+		{
+			fftWorkers.emplace_back([&, i](){
+				while(FrameBlock* block = input[i]->pop()){
+					computeBlock(*engines[i], *block, floorColumn);
+					output[i]->push(block);
+				}
+				output[i]->push(nullptr);
+			});
+		}
+
+		// sběrač; při chybě v sinku se dekodér zastaví a zbytek bloků se jen dočte
+		exception_ptr error;
+		shared_ptr<const vector<sample_t>> previousColumn;
+		for (size_t sequence = 0; ; ++sequence)
+		{
+			FrameBlock* block = output[sequence % workers]->pop();
+			if(!block)
+				break;
+			resolveDuplicates(*block, previousColumn);
+			if(!error){
+				try {
+					for (int f = 0; f < block->count; ++f)
+						sink(block->columns[f]);
+				}
+				catch (...) {
+					error = current_exception();
+					stop = true;
+				}
+			}
+			freeBlocks.push(block);
+		}
+
+		decoder.join();
+		for (thread& worker : fftWorkers)
+			worker.join();
+		if(error)
+			rethrow_exception(error);
+	}
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PLAN_CACHE_HPP
+#define PLAN_CACHE_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "fft.hpp"
+#include "window_functions.hpp"
+
+using namespace std;
+
+// předpočítané tabulky (twiddle faktory FFT, window funkce) podle parametrů
+// v CLI se použije jednou, démon je sdílí mezi všemi úlohami a vlákny
+class PlanCache
+{
+	mutex lock;
+	map<int, shared_ptr<const FFT>> ffts;
+	map<int, shared_ptr<const BatchFFT>> batchFfts;
+	map<pair<string, int>, shared_ptr<const WindowFunction>> windows;
+public:
+	shared_ptr<const FFT> getFFT(int size){
+		lock_guard<mutex> guard(lock);
+		shared_ptr<const FFT>& fft = ffts[size];
+		if(!fft){
+			shared_ptr<FFT> plan = make_shared<FFT>();
+			plan->setTransformSize(size);
+			fft = plan;
+		}
+		return fft;
+	}
+
+	shared_ptr<const BatchFFT> getBatchFFT(int size){
+		lock_guard<mutex> guard(lock);
+		shared_ptr<const BatchFFT>& fft = batchFfts[size];
+		if(!fft){
+			shared_ptr<BatchFFT> plan = make_shared<BatchFFT>();
+			plan->setTransformSize(size);
+			fft = plan;
+		}
+		return fft;
+	}
+
+	// pro neznámou window funkci vrací nullptr
+	shared_ptr<const WindowFunction> getWindow(const string& name, int size){
+		lock_guard<mutex> guard(lock);
+		auto it = windows.find(make_pair(name, size));
+		if(it != windows.end())
+			return it->second;
+
+		shared_ptr<WindowFunction> windowf = makeWindowFunction(name);
+		if(!windowf)
+			return nullptr;
+		windowf->setWindowSize(size);
+		windows[make_pair(name, size)] = windowf;
+		return windowf;
+	}
+};
+
+#endif
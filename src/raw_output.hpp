@@ -0,0 +1,204 @@
+#ifndef RAW_OUTPUT_HPP
+#define RAW_OUTPUT_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "sample_type.hpp"
+
+using namespace std;
+
+// zápis matice magnitud přímo ze smyčky STFT, bez vykreslování
+// každý sloupec (rámec) se převede do cílového typu a připojí do velkého bufferu,
+// ten se zapisuje po 4 MiB; počet rámců se doplní do hlavičky při close()
+//
+// formáty:
+//   npy - NumPy .npy verze 1.0, pole tvaru (rámce, biny), hlavička 128 bajtů
+//   raw - hlavička 36 bajtů (little endian): "SPRW", uint32 verze (1), uint32 typ
+//         (0 = f32, 1 = f16, 2 = db8), uint32 biny, uint64 rámce, uint32 sample rate,
+//         uint32 velikost rámce, uint32 posun; následují data po rámcích
+// typy hodnot:
+//   f32 - float32, f16 - float16 (IEEE half)
+//   db8 - uint8, 20*log10(magnituda / (N/2)) v rozsahu -120..0 dB lineárně na 0..255,
+//         N/2 je magnituda plného sinusového signálu s obdélníkovou window funkcí
+class SpectrumWriter
+{
+public:
+	enum ValueType { F32 = 0, F16 = 1, DB8 = 2 };
+private:
+	static const size_t flushSize = 4 << 20;
+	static const int npyHeaderSize = 128;
+	static const int rawHeaderSize = 36;
+
+	FILE* file = nullptr;
+	bool npy;
+	ValueType type;
+	int bins;
+	int samplerate;
+	int windowSize;
+	int slide;
+	uint64_t frames = 0;
+	double dbReference;
+	vector<char> buffer;
+
+	static uint16_t toHalf(float value){
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if(((bits >> 23) & 0xff) == 0xff) // inf, nan
+			return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+		if(exponent >= 31) // přetečení
+			return sign | 0x7c00;
+		if(exponent <= 0){ // subnormální čísla
+			if(exponent < -10)
+				return sign;
+			mantissa |= 0x800000;
+			int shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			uint32_t rest = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if(rest > halfway || (rest == halfway && (half & 1)))
+				half++;
+			return sign | half;
+		}
+		// zaokrouhlení na nejbližší sudé, přenos do exponentu je v pořádku
+		uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+		uint32_t rest = mantissa & 0x1fff;
+		if(rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+			half++;
+		return half;
+	}
+
+	static int valueSize(ValueType type){
+		return type == F32 ? 4 : type == F16 ? 2 : 1;
+	}
+
+	string npyHeader() const {
+		const char* descr = type == F32 ? "<f4" : type == F16 ? "<f2" : "|u1";
+		string dict = "{'descr': '" + string(descr) + "', 'fortran_order': False, 'shape': ("
+			+ to_string(frames) + ", " + to_string(bins) + "), }";
+		string header = "\x93NUMPY";
+		header += (char)1;
+		header += (char)0;
+		uint16_t length = npyHeaderSize - 10;
+		header.append((const char*)&length, sizeof(length));
+		header += dict;
+		header.append(npyHeaderSize - 1 - header.size(), ' ');
+		header += '\n';
+		return header;
+	}
+
+	string rawHeader() const {
+		string header = "SPRW";
+		auto put32 = [&header](uint32_t value){ header.append((const char*)&value, sizeof(value)); };
+		put32(1);
+		put32(type);
+		put32(bins);
+		header.append((const char*)&frames, sizeof(frames));
+		put32(samplerate);
+		put32(windowSize);
+		put32(slide);
+		return header;
+	}
+
+	void writeHeader(){
+		string header = npy ? npyHeader() : rawHeader();
+		// hlavička se při close() přepisuje na místě, délka se nesmí změnit
+		if(header.size() != (size_t)(npy ? npyHeaderSize : rawHeaderSize))
+			throw logic_error("unexpected spectrum header size");
+		if(fwrite(header.data(), 1, header.size(), file) != header.size())
+			throw runtime_error("cannot write spectrum file");
+	}
+
+	void flush(){
+		if(fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+			throw runtime_error("cannot write spectrum file");
+		buffer.clear();
+	}
+
+public:
+	SpectrumWriter(const string& filename, bool npy, ValueType type, int bins, int samplerate, int windowSize, int slide) :
+		npy(npy), type(type), bins(bins), samplerate(samplerate), windowSize(windowSize), slide(slide) {
+		dbReference = windowSize/2.0;
+		file = fopen(filename.c_str(), "wb");
+		if(!file)
+			throw runtime_error("cannot open spectrum file");
+		// vlastní buffer, stdio vyrovnávací paměť není potřeba
+		setvbuf(file, nullptr, _IONBF, 0);
+		buffer.reserve(flushSize + bins*valueSize(type));
+		// hlavička s počtem rámců 0, přepíše se v close()
+		writeHeader();
+	}
+
+	~SpectrumWriter(){
+		if(file)
+			fclose(file);
+	}
+
+	static bool parseType(const string& name, ValueType& type){
+		if(name == "f32")
+			type = F32;
+		else if(name == "f16")
+			type = F16;
+		else if(name == "db8")
+			type = DB8;
+		else
+			return false;
+		return true;
+	}
+
+	void addFrame(const vector<sample_t>& column){
+		size_t offset = buffer.size();
+		buffer.resize(offset + bins*valueSize(type));
+		char* out = buffer.data() + offset;
+		if(type == F32){
+			for (int i = 0; i < bins; ++i)
+			{
+				float value = column[i];
+				memcpy(out + i*4, &value, 4);
+			}
+		}
+		else if(type == F16){
+			for (int i = 0; i < bins; ++i)
+			{
+				uint16_t value = toHalf(column[i]);
+				memcpy(out + i*2, &value, 2);
+			}
+		}
+		else {
+			for (int i = 0; i < bins; ++i)
+			{
+				double db = 20*log10(max(column[i]/dbReference, 1e-7));
+				out[i] = (uint8_t)lround((min(max(db, -120.0), 0.0) + 120.0)/120.0*255.0);
+			}
+		}
+		frames++;
+		if(buffer.size() >= flushSize)
+			flush();
+	}
+
+	void close(){
+		flush();
+		fseek(file, 0, SEEK_SET);
+		writeHeader();
+		if(fclose(file) != 0){
+			file = nullptr;
+			throw runtime_error("cannot write spectrum file");
+		}
+		file = nullptr;
+	}
+
+	uint64_t getFrames() const {
+		return frames;
+	}
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef SAMPLE_TYPE_HPP
+#define SAMPLE_TYPE_HPP
+
+// přesnost vzorků, window funkcí, FFT a uloženého spektra
+// při kompilaci s -DSPECTROGRAM_FLOAT (make FLOAT=1) se počítá ve float32,
+// což pro 8bitový obrazový výstup stačí a zdvojnásobí počet SIMD lanes
+#ifdef SPECTROGRAM_FLOAT
+typedef float sample_t;
+#else
+typedef double sample_t;
+#endif
+
+#endif
@@ -7,30 +7,53 @@
 #include <memory>
 #include <algorithm>
 #include <numeric>
+#include <chrono>
+#include <cstdio>
 
 #include "input.hpp"
 #include "image_output.hpp"
 #include "fft.hpp"
 #include "window_functions.hpp"
+#include "waveform.hpp"
+#include "plan_cache.hpp"
+#include "spectrum_engine.hpp"
+#include "raw_output.hpp"
+#include "frame_block.hpp"
+#include "pipeline.hpp"
+#include "daemon.hpp"
 
 using namespace std;
 using namespace png;
 
-void printhelp(char* scriptName){
-	cout << "Použití: " << string(scriptName) << " [PŘEPÍNAČE] VSTUPNÍ_SOUBOR" << endl;
-	cout << "Generuje spektrogram ve formátu png ze VSTUPNÍHO SOUBORU." << endl;
-	cout << endl;
-	cout << "  -c KANÁL\t\t\tze VSTUPNÍHO SOUBORU čte KANÁL. Výchozí hodnota je 0 (1. kanál). Týká se pouze stereo nahrávek." << endl;
-	cout << "  -o VÝSTUPNÍ_SOUBOR\t\tspecifikuje název výstupní bitmapy. Výchozí název je output.png" << endl;
-	cout << "  -t VELIKOST\t\t\tnastaví velikost rámce pro FFT. Výchozí hodnota je 1024. VELIKOST musí být mocnina 2" << endl;
-	cout << "  -s DÉLKA\t\t\tnastaví délku posunutí rámce FFT. Výchozí hodnota je 128. Ovlivňuje výslednou šířku spektrogramu" << endl;
-	cout << "  -w WINDOW_FUNKCE\t\tpoužije vybranou window funkci" << endl;
-	cout << endl;
-	cout << "Seznam window funkcí:" << endl;
-	cout << "  rect\t\t Obdélníková window funkce" << endl;
-	cout << "  hann\t\t Hann window funkce" << endl;
-	cout << "  hamming\t Hamming window funkce" << endl;
-	cout << "  blackmann\t Blackman window funkce" << endl;
+// rozlišení obálky ukládané do souboru (samplů na bod)
+const vector<int> peakResolutions = {256, 2048, 16384};
+// šířka prvního náhledu v progresivním režimu
+const int previewColumns = 256;
+
+void printhelp(char* scriptName, ostream& out = cout){
+	out << "Použití: " << string(scriptName) << " [PŘEPÍNAČE] VSTUPNÍ_SOUBOR" << endl;
+	out << "Generuje spektrogram ve formátu png ze VSTUPNÍHO SOUBORU." << endl;
+	out << endl;
+	out << "  -c KANÁL\t\t\tze VSTUPNÍHO SOUBORU čte KANÁL. Výchozí hodnota je 0 (1. kanál). Týká se pouze stereo nahrávek." << endl;
+	out << "  -o VÝSTUPNÍ_SOUBOR\t\tspecifikuje název výstupního souboru. Výchozí název je output.png (output.npy, output.raw)" << endl;
+	out << "  -f FORMÁT, --format FORMÁT\tformát výstupu: png (spektrogram), npy nebo raw (matice magnitud bez vykreslování). Výchozí je png" << endl;
+	out << "  -q TYP\t\t\ttyp hodnot pro npy a raw: f32, f16 nebo db8 (uint8, -120..0 dB). Výchozí je f32" << endl;
+	out << "  -t VELIKOST\t\t\tnastaví velikost rámce pro FFT. Výchozí hodnota je 1024. VELIKOST musí být mocnina 2" << endl;
+	out << "  -s DÉLKA\t\t\tnastaví délku posunutí rámce FFT. Výchozí hodnota je 128. Ovlivňuje výslednou šířku spektrogramu" << endl;
+	out << "  -w WINDOW_FUNKCE\t\tpoužije vybranou window funkci" << endl;
+	out << "  -d SOCKET\t\t\tspustí démona, který přijímá úlohy na unixovém SOCKETU (VSTUPNÍ_SOUBOR se neuvádí)" << endl;
+	out << "  -j POČET\t\t\tpočet vláken pro výpočet FFT, v režimu démona počet souběžných úloh. Výchozí hodnota je počet jader procesoru" << endl;
+	out << "  -e ENGINE\t\t\tvýpočet spektra: batch (FFT po dávkách rámců), fft, sdft (sliding DFT, pro posun menší než rámec) nebo auto. Výchozí je auto" << endl;
+	out << "  -P\t\t\t\tprogresivní režim: nejdřív rychlý náhled z části rámců, který se postupně zpřesňuje" << endl;
+	out << "  -T SEKUNDY, --time-budget SEKUNDY\tčasový limit progresivního režimu (zapne ho), po vypršení zůstane nejlepší dosavadní obrázek" << endl;
+	out << "  -z PRÁH\t\t\trámce s RMS pod PRÁHEM (v dBFS) se nepočítají a zobrazí se jako ticho. Výchozí je jen digitální nula" << endl;
+	out << "  -p SOUBOR_OBÁLKY\t\tuloží min/max obálku vlnového průběhu (256/2048/16384 samplů na bod) do SOUBORU_OBÁLKY" << endl;
+	out << endl;
+	out << "Seznam window funkcí:" << endl;
+	out << "  rect\t\t Obdélníková window funkce" << endl;
+	out << "  hann\t\t Hann window funkce" << endl;
+	out << "  hamming\t Hamming window funkce" << endl;
+	out << "  blackmann\t Blackman window funkce" << endl;
 }
 
 class Options
@@ -38,17 +61,59 @@ class Options
 public:
 	string input = "";
 	string output = "output.png";
+	string format = "png";
+	string valueType = "f32";
 	int channel = 0;
 	int windowSize = 1024;
 	int windowSlide = 128;
 	string windowFunction = "hann";
-	void process(char** argv) {
+	string peakFile = "";
+	string engine = "auto";
+	bool progressive = false;
+	// časový limit v sekundách, 0 = bez limitu
+	double timeBudget = 0;
+	// práh ticha v dBFS, -inf = pouze digitální nula
+	double silenceThreshold = -INFINITY;
+	string daemonSocket = "";
+	int workers = max(1u, thread::hardware_concurrency());
+	// výpis nápovědy (-h) jde do logu, u démona do odpovědi klientovi
+	void process(char** argv, ostream& log = cout) {
 		char* scriptName = argv[0];
+		bool outputSet = false;
 		while (*++argv && **argv == '-')
 		{
 			switch (argv[0][1]) {
+			case '-':
+				if (string(argv[0]) == "--format" && *++argv)
+					format = string(argv[0]);
+				else if (string(argv[0]) == "--time-budget" && *++argv)
+					setTimeBudget(argv[0]);
+				else
+					error();
+				break;
+			case 'P':
+				progressive = true;
+				break;
+			case 'T':
+				if (*++argv)
+					setTimeBudget(argv[0]);
+				else
+					error();
+				break;
+			case 'f':
+				if (*++argv)
+					format = string(argv[0]);
+				else
+					error();
+				break;
+			case 'q':
+				if (*++argv)
+					valueType = string(argv[0]);
+				else
+					error();
+				break;
 			case 'h':
-				printhelp(scriptName);
+				printhelp(scriptName, log);
 				break;
 			case 'c':
 				if (*++argv)
@@ -76,7 +141,40 @@ public:
 				break;
 			case 'o':
 				if (*++argv)
+				{
 					output = string(argv[0]);
+					outputSet = true;
+				}
+				else
+					error();
+				break;
+			case 'd':
+				if (*++argv)
+					daemonSocket = string(argv[0]);
+				else
+					error();
+				break;
+			case 'j':
+				if (*++argv)
+					workers = stoi(string(argv[0]));
+				else
+					error();
+				break;
+			case 'e':
+				if (*++argv)
+					engine = string(argv[0]);
+				else
+					error();
+				break;
+			case 'z':
+				if (*++argv)
+					silenceThreshold = stod(string(argv[0]));
+				else
+					error();
+				break;
+			case 'p':
+				if (*++argv)
+					peakFile = string(argv[0]);
 				else
 					error();
 				break;
@@ -89,43 +187,196 @@ public:
 		if (argv[0]) {
 			input = string(argv[0]);
 		}
+
+		if (!outputSet && format != "png")
+			output = "output." + format;
 	}
 private:
 	void error() const {
 		throw invalid_argument("chyba v přepínačích");
 	}
+	void setTimeBudget(const char* value){
+		timeBudget = stod(string(value));
+		if(timeBudget <= 0)
+			error();
+		progressive = true;
+	}
 };
 
-int main(int argc, char** argv)
+// sestaví obrázek ze sloupců spektra a vlnového průběhu (jeden bod na sloupec)
+void writeImage(const string& filename, const vector<shared_ptr<const vector<sample_t>>>& columns,
+	const vector<sample_t>& waveMins, const vector<sample_t>& waveMaxs,
+	shared_ptr<const WindowFunction> windowf, int windowSize, SndfileHandle& file)
 {
-	// zpracování vstupních argumentů
-	if(argc == 1){
-		printhelp(argv[0]);
-		return 0;
-	}
+	// zobrazovací komponenty
+	unique_ptr<FFTRenderer> fftrender = make_unique<FFTRenderer>();
+	unique_ptr<WaveRenderer> waverender = make_unique<WaveRenderer>();
+	unique_ptr<AveragesRenderer> averagesrender = make_unique<AveragesRenderer>();
 
-	Options options;
-	try {
-		options.process(argv);
+	// předání hodnot do tříd zajišťujících grafický výstup
+	for (const shared_ptr<const vector<sample_t>>& column : columns)
+	{
+		averagesrender->addFrame(*column);
+		fftrender->addFrame(column);
 	}
-	catch (const invalid_argument & e) {
-		cout << e.what() <<endl;
-		return 1;
+	for (size_t i = 0; i < waveMaxs.size(); ++i)
+	{
+		waverender->addPeak(waveMins[i], waveMaxs[i]);
 	}
 
+	// grafický výstup
+	ImageOutput imageOut;
+
+	// umístění komponent
+	waverender->y = fftrender->getHeight()+10; // pod FFT
+	averagesrender->x = fftrender->getWidth()+10; // napravo od FFT
+
+	// měřítko os (sloupce pokrývají vždy celou nahrávku)
+	double timescale = file.frames()/((double)file.samplerate());
+	double freqscale = file.samplerate()/2.0;
+	unique_ptr<ScaleRenderer> fftscale = make_unique<ScaleRenderer>(0, 0, fftrender->getWidth(), fftrender->getHeight(), timescale, freqscale, 0.5, 1000);
+	unique_ptr<ScaleRenderer> wavescale = make_unique<ScaleRenderer>(0, waverender->y, waverender->getWidth(), waverender->getHeight(), timescale, -1, 0.5, -1);
+	unique_ptr<ScaleRenderer> averagesscale = make_unique<ScaleRenderer>(averagesrender->x, 0, averagesrender->getWidth(), averagesrender->getHeight(), -1, freqscale, -1, 1000);
+
+	// zobrazení window funkce
+	imageOut.addBlock(make_unique<WindowRenderer>(averagesrender->x+15, waverender->y+30, 70, 70, windowf, windowSize));
+
+	imageOut.addBlock(move(fftrender));
+	imageOut.addBlock(move(waverender));
+	imageOut.addBlock(move(averagesrender));
+
+	imageOut.addBlock(move(fftscale));
+	imageOut.addBlock(move(wavescale));
+	imageOut.addBlock(move(averagesscale));
+
+	// výstup
+	imageOut.renderImage(filename);
+
+}
+
+// progresivní režim: nejdřív hrubý průchod přes každý stride-tý rámec a hned náhled,
+// pak se stride půlí a doplňují se chybějící rámce, po každé fázi se obrázek přepíše
+// (přes dočasný soubor a rename, prohlížeč tak nikdy nevidí rozepsaný soubor);
+// po vypršení časového limitu zůstane obrázek z poslední dokončené fáze
+int renderProgressive(const Options& options, SndfileHandle& file, ChannelReader& cr, SpectrumEngine& engine,
+	shared_ptr<const WindowFunction> windowf, int windowSize, int slide, ostream& log)
+{
+	auto start = chrono::steady_clock::now();
+	auto expired = [&](){
+		return options.timeBudget > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= options.timeBudget;
+	};
+
+	// rámec i začíná na samplu i*slide, stejně jako při čtení SlidingWindow
+	long total = file.frames() >= windowSize ? (file.frames() - windowSize)/slide + 1 : 0;
+	long stride = 1;
+	while(total/(stride*2) >= previewColumns)
+		stride *= 2;
+
+	vector<shared_ptr<const vector<sample_t>>> columns(total);
+	// vlnový průběh z prvních slide samplů každého spočítaného rámce
+	vector<sample_t> mins(total, 0);
+	vector<sample_t> maxs(total, 0);
+	int waveSamples = min(slide, windowSize);
+
+	FrameClassifier classifier(windowSize, options.silenceThreshold);
+	shared_ptr<const vector<sample_t>> floorColumn = make_shared<const vector<sample_t>>(windowSize/2, 0);
+	FrameBlock block(engine.getBatchSize(), windowSize);
+	vector<long> indices(block.frames.size());
+
+	// sloupce j*stride, chybějící se doplní nejbližším předchozím spočítaným
+	long writtenStride = 0;
+	auto writeStage = [&](long stride){
+		writtenStride = stride;
+		vector<shared_ptr<const vector<sample_t>>> stageColumns;
+		vector<sample_t> stageMins;
+		vector<sample_t> stageMaxs;
+		shared_ptr<const vector<sample_t>> last = floorColumn;
+		for (long i = 0; i < total; i += stride)
+		{
+			if(columns[i])
+				last = columns[i];
+			stageColumns.push_back(last);
+			stageMins.push_back(mins[i]);
+			stageMaxs.push_back(maxs[i]);
+		}
+		string tmp = options.output + ".tmp";
+		writeImage(tmp, stageColumns, stageMins, stageMaxs, windowf, windowSize, file);
+		rename(tmp.c_str(), options.output.c_str());
+		log << "  Náhled: " << stageColumns.size() << " sloupců, "
+			<< chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+	};
+
+	for (; stride >= 1; stride /= 2)
+	{
+		// opakování se hledá jen mezi rámci této fáze, previousColumn patří
+		// k poslednímu klasifikovanému rámci, takže žádný sloupec nezůstane prázdný
+		// a každý rámec se klasifikuje (a započítá) jen jednou
+		classifier.reset();
+		shared_ptr<const vector<sample_t>> previousColumn;
+		bool interrupted = false;
+		long i = 0;
+		while(i < total){
+			// blok z rámců této fáze, které ještě nebyly spočítané
+			block.count = 0;
+			for (; i < total && block.count < (int)block.frames.size(); i += stride)
+			{
+				if(columns[i])
+					continue;
+				vector<sample_t>& frame = block.frames[block.count];
+				cr.seek(i*slide);
+				cr.read(frame, windowSize);
+				mins[i] = *min_element(frame.begin(), frame.begin()+waveSamples);
+				maxs[i] = *max_element(frame.begin(), frame.begin()+waveSamples);
+				indices[block.count++] = i;
+			}
+
+			classifier.classify(block);
+			computeBlock(engine, block, floorColumn);
+			resolveDuplicates(block, previousColumn);
+			for (int f = 0; f < block.count; ++f)
+				columns[indices[f]] = block.columns[f];
+
+			if(expired()){
+				interrupted = true;
+				break;
+			}
+		}
+
+		if(!interrupted){
+			writeStage(stride);
+		}
+		else {
+			// ještě žádný náhled, zapíše se alespoň to, co je spočítané
+			if(writtenStride == 0)
+				writeStage(stride);
+			break;
+		}
+		if(stride > 1 && expired())
+			break;
+	}
+
+	log << "  Přeskočené rámce: " << classifier.silentFrames << " tichých, " << classifier.duplicateFrames << " opakovaných" << endl;
+	if(writtenStride > 1)
+		log << "  Časový limit vypršel, výsledek je náhled s každým " << writtenStride << ". rámcem" << endl;
+	return 0;
+}
+
+// zpracuje jeden vstupní soubor, výpis jde do logu (cout nebo odpověď démona)
+int renderSpectrogram(const Options& options, PlanCache& cache, ostream& log)
+{
 	if(options.input == ""){
-		cout << "chybějící vstupní soubor"<<endl;
+		log << "chybějící vstupní soubor"<<endl;
 		return 1;
 	}
 
 	// nastavení délky posouvání rámce
 	int slide = options.windowSlide;
 	if(slide <= 0){
-		cout << "neplatná délka posunutí rámce" << endl;
+		log << "neplatná délka posunutí rámce" << endl;
 		return 1;
 	}
 
-	cout << "Vstupní soubor: " << options.input << endl;
+	log << "Vstupní soubor: " << options.input << endl;
 
 	// načtení souboru
 	SndfileHandle file;
@@ -133,16 +384,16 @@ int main(int argc, char** argv)
 
 	// kontrola, zda-li je soubor platný
 	if(file.samplerate() == 0 || file.channels() == 0 || file.frames() == 0){
-		cout << "chyba vstupního souboru"<<endl;
+		log << "chyba vstupního souboru"<<endl;
 		return 1;
 	}
 
-	cout << "  Sample rate: " << file.samplerate() << endl;
-	cout << "  Channels: " << file.channels() << endl;
-	cout << "  Frames: " << file.frames() << endl;
+	log << "  Sample rate: " << file.samplerate() << endl;
+	log << "  Channels: " << file.channels() << endl;
+	log << "  Frames: " << file.frames() << endl;
 
-	cout << "Výstupní soubor: " << options.output << endl;
-	cout << "  Rozměr spektrogramu: " << file.frames()/options.windowSlide << "x" << options.windowSize/2 << endl;
+	log << "Výstupní soubor: " << options.output << endl;
+	log << "  Rozměr spektrogramu: " << file.frames()/options.windowSlide << "x" << options.windowSize/2 << endl;
 
 	// nastavení čtení zvoleného kanálu
 	ChannelReader cr(file);
@@ -150,96 +401,218 @@ int main(int argc, char** argv)
 		cr.setChannel(options.channel);
 	}
 	catch (const invalid_argument &) {
-		cout << "neplatný kanál" << endl;
-		return 1;
-	}
-
-	// nastavení window funkce
-	unique_ptr<WindowFunction> windowf;
-	if(options.windowFunction == "rect")
-		windowf = make_unique<RectangleWindowFunction>();
-	else if(options.windowFunction == "hann")
-		windowf = make_unique<HannWindowFunction>();
-	else if(options.windowFunction == "hamming")
-		windowf = make_unique<HammingWindowFunction>();
-	else if(options.windowFunction == "blackmann")
-		windowf = make_unique<BlackmannWindowFunction>();
-	else {
-		cout << "neplatná window funkce"<<endl;
+		log << "neplatný kanál" << endl;
 		return 1;
 	}
 
 	// nastavení velikosti rámce
 	int windowSize = options.windowSize;
 	if((windowSize & (windowSize - 1)) != 0 || windowSize < 8){
-		cout << "neplatná velikost rámce"<<endl;
+		log << "neplatná velikost rámce"<<endl;
 		return 1;
 	}
-	windowf->setWindowSize(windowSize);
+
+	// nastavení window funkce (předpočítaná tabulka z cache)
+	shared_ptr<const WindowFunction> windowf = cache.getWindow(options.windowFunction, windowSize);
+	if(!windowf){
+		log << "neplatná window funkce"<<endl;
+		return 1;
+	}
+
+	// obálka vlnového průběhu, počítá se ze všech přečtených samplů
+	WaveformEnvelope envelope;
+	envelope.addLevel(slide); // jeden bod na sloupec spektrogramu
+	if(options.peakFile != ""){
+		for (int resolution : peakResolutions)
+			envelope.addLevel(resolution);
+	}
+	// v progresivním režimu se čte na přeskáčku, obálka se z rámců odhaduje zvlášť
+	if(!options.progressive)
+		cr.setEnvelope(&envelope);
 
 	// čtení souboru posuvným oknem
 	SlidingWindow sw(cr);
 	sw.setWindow(windowSize, slide);
 
-	// zobrazovací komponenty
-	unique_ptr<FFTRenderer> fftrender = make_unique<FFTRenderer>();
-	unique_ptr<WaveRenderer> waverender = make_unique<WaveRenderer>();
-	unique_ptr<AveragesRenderer> averagesrender = make_unique<AveragesRenderer>();
+	// výběr výpočtu spektra, sliding DFT pro malé posuny, jinak FFT po dávkách
+	// automaticky jen tehdy, když dává stejné spektrum jako FFT (viz matchesTimeDomain)
+	bool sdftSupported = SlidingDFTEngine::supports(*windowf, windowSize, slide);
+	// progresivní režim počítá rámce mimo pořadí, sliding DFT tam nejde použít
+	if(options.progressive)
+		sdftSupported = false;
+	string engineType = options.engine;
+	if(engineType == "auto")
+		engineType = sdftSupported && SlidingDFTEngine::matchesTimeDomain(*windowf, windowSize)
+			&& SlidingDFTEngine::isCheaper(windowSize, slide) ? "sdft" : "batch";
+	if(engineType == "sdft"){
+		if(options.progressive){
+			log << "sliding DFT nelze použít v progresivním režimu" << endl;
+			return 1;
+		}
+		if(!sdftSupported){
+			log << "sliding DFT vyžaduje posun menší než velikost rámce" << endl;
+			return 1;
+		}
+		log << "  Výpočet spektra: sliding DFT" << endl;
+		if(!SlidingDFTEngine::matchesTimeDomain(*windowf, windowSize))
+			log << "  (periodická varianta window funkce, spektrum se liší od FFT)" << endl;
+	}
+	else if(engineType != "batch" && engineType != "fft"){
+		log << "neplatný výpočet spektra" << endl;
+		return 1;
+	}
+	// každý FFT worker má vlastní engine (pracovní buffery), tabulky jsou sdílené z cache
+	StftPipeline::EngineFactory makeEngine = [&]() -> unique_ptr<SpectrumEngine> {
+		if(engineType == "sdft")
+			return make_unique<SlidingDFTEngine>(cache.getFFT(windowSize), windowf, windowSize, slide);
+		if(engineType == "batch")
+			return make_unique<BatchFFTEngine>(cache.getBatchFFT(windowSize), windowf, windowSize);
+		return make_unique<FFTEngine>(cache.getFFT(windowSize), windowf, windowSize);
+	};
+
+	// tiché rámce sdílí jeden nulový sloupec, opakující se rámce sdílí předchozí výsledek
+	FrameClassifier classifier(windowSize, options.silenceThreshold);
+
+	// všechny přepínače se zkontrolují dřív, než se otevře (a zkrátí) výstupní soubor
+	bool spectrumOutput = options.format != "png";
+	SpectrumWriter::ValueType valueType = SpectrumWriter::F32;
+	if(spectrumOutput && ((options.format != "npy" && options.format != "raw") || !SpectrumWriter::parseType(options.valueType, valueType))){
+		log << "neplatný formát výstupu" << endl;
+		return 1;
+	}
+	if(options.progressive && (spectrumOutput || options.peakFile != "")){
+		log << "progresivní režim podporuje pouze výstup png bez souboru obálky" << endl;
+		return 1;
+	}
 
-	FFT fft;
-	fft.setTransformSize(windowSize);
+	// npy/raw: magnitudy se zapisují rovnou do souboru, nic se nevykresluje
+	unique_ptr<SpectrumWriter> writer;
+	if(spectrumOutput){
+		try {
+			writer = make_unique<SpectrumWriter>(options.output, options.format == "npy", valueType, windowSize/2, file.samplerate(), windowSize, slide);
+		}
+		catch (const runtime_error &) {
+			log << "chyba zápisu výstupního souboru" << endl;
+			return 1;
+		}
+	}
 
-	// buffer pro čtení zvukového souboru
-	vector<double> buffer;
-	// buffer pro výsledky fourierovy transformace
-	vector<double> fourierBuffer;
-	buffer.resize(windowSize);
-	// fourierBuffer má dvojnásobnou velikost kvůli imaginárním částem
-	fourierBuffer.resize(windowSize*2);
+	if(options.progressive){
+		unique_ptr<SpectrumEngine> engine = makeEngine();
+		return renderProgressive(options, file, cr, *engine, windowf, windowSize, slide, log);
+	}
 
-	while(sw.read(buffer, windowSize)){
-		// smazání imaginárních částí z minulého výpočtu
-		fill(fourierBuffer.begin()+windowSize, fourierBuffer.end(), 0);
-		// přepis z bufferu do fourierBufferu + aplikace window funkce
-		for (int i = 0; i < windowSize; i++){
-			fourierBuffer[i] = windowf->apply(buffer[i], i);
-		}
+	// spočítané sloupce spektrogramu
+	vector<shared_ptr<const vector<sample_t>>> columns;
 
-		vector<double> mag = fft.getMagnitudes(fourierBuffer);
+	// dekódování, FFT a sběr sloupců běží ve vlastních vláknech, rámce po dávkách podle enginu
+	// sliding DFT potřebuje všechny rámce v pořadí, proto jen jeden FFT worker
+	int fftWorkers = engineType == "sdft" ? 1 : options.workers;
+	StftPipeline pipeline(sw, classifier, makeEngine, fftWorkers, windowSize);
+	try {
+		pipeline.run([&](const shared_ptr<const vector<sample_t>>& column){
+			if(writer)
+				writer->addFrame(*column);
+			else
+				columns.push_back(column);
+		});
+	}
+	catch (const runtime_error &) {
+		log << "chyba zápisu výstupního souboru" << endl;
+		return 1;
+	}
+
+	log << "  Přeskočené rámce: " << classifier.silentFrames << " tichých, " << classifier.duplicateFrames << " opakovaných" << endl;
 
-		// předání hodnot do tříd zajišťujících grafický výstup
-		waverender->addFrame(buffer, slide);
-		averagesrender->addFrame(mag);
-		fftrender->addFrame(mag);
+	envelope.finish();
+	if(options.peakFile != ""){
+		try {
+			envelope.write(options.peakFile, file.samplerate(), peakResolutions);
+		}
+		catch (const runtime_error &) {
+			log << "chyba zápisu souboru obálky" << endl;
+			return 1;
+		}
+		log << "Soubor obálky: " << options.peakFile << endl;
 	}
 
-	// grafický výstup
-	ImageOutput imageOut;
+	if(writer){
+		try {
+			writer->close();
+		}
+		catch (const runtime_error &) {
+			log << "chyba zápisu výstupního souboru" << endl;
+			return 1;
+		}
+		log << "  Zapsáno rámců: " << writer->getFrames() << endl;
+		return 0;
+	}
 
-	// umístění komponent
-	waverender->y = fftrender->getHeight()+10; // pod FFT
-	averagesrender->x = fftrender->getWidth()+10; // napravo od FFT
+	// vlnový průběh, jeden bod obálky na sloupec spektrogramu
+	const WaveformEnvelope::Level& wave = envelope.getLevel(slide);
+	size_t width = min(columns.size(), wave.maxs.size());
+	vector<sample_t> waveMins(wave.mins.begin(), wave.mins.begin()+width);
+	vector<sample_t> waveMaxs(wave.maxs.begin(), wave.maxs.begin()+width);
 
-	// měřítko os
-	double timescale = file.frames()/((double)file.samplerate());
-	double freqscale = file.samplerate()/2.0;
-	unique_ptr<ScaleRenderer> fftscale = make_unique<ScaleRenderer>(0, 0, fftrender->getWidth(), fftrender->getHeight(), timescale, freqscale, 0.5, 1000);
-	unique_ptr<ScaleRenderer> wavescale = make_unique<ScaleRenderer>(0, waverender->y, waverender->getWidth(), waverender->getHeight(), timescale, -1, 0.5, -1);
-	unique_ptr<ScaleRenderer> averagesscale = make_unique<ScaleRenderer>(averagesrender->x, 0, averagesrender->getWidth(), averagesrender->getHeight(), -1, freqscale, -1, 1000);
+	writeImage(options.output, columns, waveMins, waveMaxs, windowf, windowSize, file);
 
-	// zobrazení window funkce
-	imageOut.addBlock(make_unique<WindowRenderer>(averagesrender->x+15, waverender->y+30, 70, 70, move(windowf), windowSize));
+	return 0;
+}
 
-	imageOut.addBlock(move(fftrender));
-	imageOut.addBlock(move(waverender));
-	imageOut.addBlock(move(averagesrender));
+int main(int argc, char** argv)
+{
+	// zpracování vstupních argumentů
+	if(argc == 1){
+		printhelp(argv[0]);
+		return 0;
+	}
 
-	imageOut.addBlock(move(fftscale));
-	imageOut.addBlock(move(wavescale));
-	imageOut.addBlock(move(averagesscale));
+	Options options;
+	try {
+		options.process(argv);
+	}
+	catch (const invalid_argument & e) {
+		cout << e.what() <<endl;
+		return 1;
+	}
 
-	// výstup
-	imageOut.renderImage(options.output);
+	PlanCache cache;
+
+	if(options.daemonSocket == "")
+		return renderSpectrogram(options, cache, cout);
+
+	// démon, úlohy mají stejné přepínače jako příkazová řádka
+	RenderDaemon daemon(options.daemonSocket, options.workers, [&cache](const vector<string>& args, ostream& log){
+		vector<char*> jobArgv;
+		jobArgv.push_back((char*)"spectrogram");
+		for (const string& arg : args)
+			jobArgv.push_back((char*)arg.c_str());
+		jobArgv.push_back(nullptr);
 
+		Options jobOptions;
+		try {
+			jobOptions.process(jobArgv.data(), log);
+		}
+		catch (const logic_error & e) {
+			log << e.what() << endl;
+			return 1;
+		}
+		if(jobOptions.daemonSocket != ""){
+			log << "chyba v přepínačích" << endl;
+			return 1;
+		}
+		// démon paralelizuje přes úlohy, každá úloha počítá FFT v jednom vlákně
+		jobOptions.workers = 1;
+		return renderSpectrogram(jobOptions, cache, log);
+	});
+
+	cout << "Démon naslouchá na " << options.daemonSocket << endl;
+	try {
+		daemon.run();
+	}
+	catch (const exception & e) {
+		cout << e.what() << endl;
+		return 1;
+	}
 	return 0;
 }
@@ -0,0 +1,263 @@
+#ifndef SPECTRUM_ENGINE_HPP
+#define SPECTRUM_ENGINE_HPP
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "sample_type.hpp"
+#include "fft.hpp"
+#include "window_functions.hpp"
+
+using namespace std;
+
+// výpočet magnitud spektra pro po sobě jdoucí rámce posuvného okna
+class SpectrumEngine
+{
+public:
+	virtual ~SpectrumEngine() {};
+	// rámce přichází postupně, tak jak je čte SlidingWindow
+	virtual vector<sample_t> getMagnitudes(const vector<sample_t>& frame) = 0;
+	// rámec, pro který se spektrum nepočítalo (ticho, opakování)
+	virtual void skip(const vector<sample_t>& frame) {};
+	// engine se stavem potřebuje dostávat spočítané i přeskočené rámce v pořadí
+	virtual bool needsOrderedSkip() const {
+		return false;
+	}
+
+	// počet rámců, které se vyplatí předat najednou
+	virtual int getBatchSize() const {
+		return 1;
+	}
+	// magnitudy pro několik po sobě jdoucích rámců, výchozí implementace po jednom
+	virtual void getBatchMagnitudes(const vector<const vector<sample_t>*>& frames, vector<vector<sample_t>>& magnitudes){
+		magnitudes.resize(frames.size());
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			magnitudes[i] = getMagnitudes(*frames[i]);
+		}
+	}
+};
+
+// window funkce v časové oblasti + celá FFT pro každý rámec
+class FFTEngine : public SpectrumEngine
+{
+	shared_ptr<const FFT> fft;
+	shared_ptr<const WindowFunction> windowf;
+	int windowSize;
+	// fourierBuffer má dvojnásobnou velikost kvůli imaginárním částem
+	vector<sample_t> fourierBuffer;
+public:
+	FFTEngine(shared_ptr<const FFT> fft, shared_ptr<const WindowFunction> windowf, int windowSize) :
+		fft(fft), windowf(windowf), windowSize(windowSize), fourierBuffer(windowSize*2) {}
+
+	virtual vector<sample_t> getMagnitudes(const vector<sample_t>& frame){
+		// smazání imaginárních částí z minulého výpočtu
+		fill(fourierBuffer.begin()+windowSize, fourierBuffer.end(), 0);
+		// přepis z rámce do fourierBufferu + aplikace window funkce
+		for (int i = 0; i < windowSize; i++){
+			fourierBuffer[i] = windowf->apply(frame[i], i);
+		}
+		return fft->getMagnitudes(fourierBuffer);
+	}
+};
+
+// dávka rámců přes BatchFFT, každý rámec v jedné SIMD lane
+// výsledky odpovídají FFTEngine až na zaokrouhlení (iterativní místo rekurzivní FFT)
+class BatchFFTEngine : public SpectrumEngine
+{
+	shared_ptr<const BatchFFT> fft;
+	int windowSize;
+	vector<sample_t> window;
+	vector<sample_t> re;
+	vector<sample_t> im;
+	static const int lanes = BatchFFT::lanes;
+public:
+	BatchFFTEngine(shared_ptr<const BatchFFT> fft, shared_ptr<const WindowFunction> windowf, int windowSize) :
+		fft(fft), windowSize(windowSize), window(windowSize), re(windowSize*lanes), im(windowSize*lanes) {
+		for (int i = 0; i < windowSize; ++i)
+		{
+			window[i] = windowf->apply(1, i);
+		}
+	}
+
+	virtual int getBatchSize() const {
+		return lanes;
+	}
+
+	virtual vector<sample_t> getMagnitudes(const vector<sample_t>& frame){
+		vector<vector<sample_t>> magnitudes;
+		getBatchMagnitudes({&frame}, magnitudes);
+		return magnitudes[0];
+	}
+
+	virtual void getBatchMagnitudes(const vector<const vector<sample_t>*>& frames, vector<vector<sample_t>>& magnitudes){
+		magnitudes.resize(frames.size());
+		for (size_t first = 0; first < frames.size(); first += lanes)
+		{
+			int count = min((int)(frames.size() - first), (int)lanes);
+			// transpozice do SoA + aplikace window funkce, nevyužité lanes jsou nulové
+			for (int i = 0; i < windowSize; ++i)
+			{
+				for (int l = 0; l < lanes; ++l)
+				{
+					re[i*lanes + l] = l < count ? (*frames[first+l])[i]*window[i] : 0;
+				}
+			}
+			fill(im.begin(), im.end(), 0);
+
+			fft->transform(re.data(), im.data());
+
+			for (int l = 0; l < count; ++l)
+			{
+				vector<sample_t>& column = magnitudes[first+l];
+				column.resize(windowSize/2);
+				for (int k = 0; k < windowSize/2; ++k)
+				{
+					sample_t r = re[k*lanes + l];
+					sample_t i = im[k*lanes + l];
+					column[k] = sqrt(r*r + i*i);
+				}
+			}
+		}
+	}
+};
+
+// sliding DFT: při malém posunu se každý bin aktualizuje rekurzivně po jednotlivých
+// samplech, X_k <- (X_k + x_new - x_old) * e^(j2πk/N), místo celé FFT
+// window funkce se aplikuje ve frekvenční oblasti jako konvoluce s kosinovými členy
+// (Hann = 3 koeficienty), odpovídá tedy periodické variantě window funkce;
+// nahromaděná chyba rekurze se pravidelně nuluje přepočtem celou FFT
+// https://en.wikipedia.org/wiki/Sliding_DFT
+class SlidingDFTEngine : public SpectrumEngine
+{
+	shared_ptr<const FFT> fft;
+	vector<double> terms;
+	int windowSize;
+	int slide;
+	int bins;
+	int resyncInterval;
+
+	// stav DFT pro biny 0..bins-1 (magnitudy + přesah konvoluce s window funkcí)
+	vector<double> re;
+	vector<double> im;
+	vector<double> twiddler;
+	vector<double> twiddlei;
+
+	vector<sample_t> previous;
+	vector<sample_t> fourierBuffer;
+	bool synced = false;
+	int samplesSinceSync = 0;
+
+	void resync(const vector<sample_t>& frame){
+		copy(frame.begin(), frame.end(), fourierBuffer.begin());
+		fill(fourierBuffer.begin()+windowSize, fourierBuffer.end(), 0);
+		fft->transform(fourierBuffer);
+		for (int k = 0; k < bins; ++k)
+		{
+			re[k] = fourierBuffer[k];
+			im[k] = fourierBuffer[k+windowSize];
+		}
+		synced = true;
+		samplesSinceSync = 0;
+	}
+
+	void update(const vector<sample_t>& frame){
+		for (int j = 0; j < slide; ++j)
+		{
+			double delta = (double)frame[windowSize-slide+j] - previous[j];
+			for (int k = 0; k < bins; ++k)
+			{
+				double r = re[k] + delta;
+				double i = im[k];
+				re[k] = r*twiddler[k] - i*twiddlei[k];
+				im[k] = r*twiddlei[k] + i*twiddler[k];
+			}
+		}
+		samplesSinceSync += slide;
+	}
+
+public:
+	SlidingDFTEngine(shared_ptr<const FFT> fft, shared_ptr<const WindowFunction> windowf, int windowSize, int slide) :
+		fft(fft), terms(windowf->getCosineTerms()), windowSize(windowSize), slide(slide),
+		previous(windowSize), fourierBuffer(windowSize*2) {
+		bins = windowSize/2 + terms.size();
+		// přepočet zhruba po 16 délkách rámce, chyba rekurze v double je do té doby zanedbatelná
+		resyncInterval = 16*windowSize;
+		re.resize(bins);
+		im.resize(bins);
+		twiddler.resize(bins);
+		twiddlei.resize(bins);
+		for (int k = 0; k < bins; ++k)
+		{
+			twiddler[k] = cos(2*M_PI*k/windowSize);
+			twiddlei[k] = sin(2*M_PI*k/windowSize);
+		}
+	}
+
+	// sliding DFT se vyplatí, pokud je posun vůči velikosti rámce malý
+	// aktualizace stojí slide*N/2 komplexních násobení, FFT (N/2)*log2(N);
+	// naměřená hranice proti BatchFFTEngine pro N = 256..4096 je zhruba log2(N)
+	static bool isCheaper(int windowSize, int slide){
+		return slide < log2(windowSize);
+	}
+
+	// window funkce musí jít vyjádřit kosinovými členy
+	static bool supports(const WindowFunction& windowf, int windowSize, int slide){
+		return slide < windowSize && !windowf.getCosineTerms().empty();
+	}
+
+	// true, pokud kosinové členy dávají stejnou window funkci jako v časové oblasti
+	// (obdélníková), symetrické varianty (Hann, ...) se od periodické liší a
+	// spektrum by se od FFT výrazně lišilo
+	static bool matchesTimeDomain(const WindowFunction& windowf, int windowSize){
+		vector<double> terms = windowf.getCosineTerms();
+		for (int n = 0; n < windowSize; ++n)
+		{
+			double periodic = 0;
+			for (size_t m = 0; m < terms.size(); ++m)
+			{
+				periodic += (m % 2 ? -1 : 1)*terms[m]*cos(2*M_PI*m*n/windowSize);
+			}
+			if(fabs(periodic - windowf.apply(1, n)) > 1e-6)
+				return false;
+		}
+		return true;
+	}
+
+	virtual vector<sample_t> getMagnitudes(const vector<sample_t>& frame){
+		if(!synced || samplesSinceSync >= resyncInterval)
+			resync(frame);
+		else
+			update(frame);
+		copy(frame.begin(), frame.end(), previous.begin());
+
+		// konvoluce s window funkcí, záporné biny jsou komplexně sdružené ke kladným
+		vector<sample_t> magnitudes(windowSize/2);
+		for (int k = 0; k < windowSize/2; ++k)
+		{
+			double r = terms[0]*re[k];
+			double i = terms[0]*im[k];
+			for (int m = 1; m < (int)terms.size(); ++m)
+			{
+				double a = (m % 2 ? -0.5 : 0.5)*terms[m];
+				int lower = k-m;
+				r += a*(re[abs(lower)] + re[k+m]);
+				i += a*((lower < 0 ? -im[-lower] : im[lower]) + im[k+m]);
+			}
+			magnitudes[k] = sqrt(r*r + i*i);
+		}
+		return magnitudes;
+	}
+
+	virtual void skip(const vector<sample_t>& frame){
+		// rekurze potřebuje všechny rámce, po přeskočení se začne znovu celou FFT
+		synced = false;
+	}
+
+	virtual bool needsOrderedSkip() const {
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef WAVEFORM_HPP
+#define WAVEFORM_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include "sample_type.hpp"
+
+using namespace std;
+
+// obálka vlnového průběhu v několika rozlišeních (min/max pyramida)
+// úrovně, které jsou násobkem pyramidBlock (soubor s obálkou), se skládají
+// z bloků pevné délky; ostatní (posun rámce pro WaveRenderer) redukují samply
+// přímo po svých bodech, takže malý nebo lichý posun nezkrátí bloky pyramidy
+// a obě redukce zůstanou vektorové
+class WaveformEnvelope
+{
+public:
+	struct Level {
+		int samplesPerPoint;
+		vector<sample_t> mins;
+		vector<sample_t> maxs;
+
+		// rozpracovaný bod
+		int pending = 0;
+		sample_t curMin = 0;
+		sample_t curMax = 0;
+	};
+private:
+	static const int pyramidBlock = 256;
+
+	// úrovně skládané z bloků pyramidBlock samplů
+	vector<Level> levels;
+	// úrovně s vlastní redukcí
+	vector<Level> directLevels;
+
+	// rozpracovaný blok pyramidy
+	int blockFill = 0;
+	sample_t blockMin;
+	sample_t blockMax;
+
+	static void reduce(const sample_t* data, int n, sample_t& minValue, sample_t& maxValue){
+		// min/max nad floaty kompilátor bez -ffast-math sám nevektorizuje (pořadí
+		// při NaN), proto explicitně přes vektorová rozšíření GCC: 16 bajtů je jeden
+		// SSE registr (minpd/maxpd, resp. minps/maxps), dva páry akumulátorů
+		// překryjí latenci instrukcí
+		typedef sample_t vec __attribute__((vector_size(16)));
+		const int width = sizeof(vec)/sizeof(sample_t);
+		int i = 0;
+		if(n >= 2*width){
+			vec mn0, mn1;
+			memcpy(&mn0, data, sizeof(vec));
+			memcpy(&mn1, data+width, sizeof(vec));
+			vec mx0 = mn0;
+			vec mx1 = mn1;
+			for (i = 2*width; i + 2*width <= n; i += 2*width)
+			{
+				vec a, b;
+				memcpy(&a, data+i, sizeof(vec));
+				memcpy(&b, data+i+width, sizeof(vec));
+				mn0 = a < mn0 ? a : mn0;
+				mn1 = b < mn1 ? b : mn1;
+				mx0 = a > mx0 ? a : mx0;
+				mx1 = b > mx1 ? b : mx1;
+			}
+			mn0 = mn1 < mn0 ? mn1 : mn0;
+			mx0 = mx1 > mx0 ? mx1 : mx0;
+			for (int l = 0; l < width; ++l)
+			{
+				minValue = mn0[l] < minValue ? mn0[l] : minValue;
+				maxValue = mx0[l] > maxValue ? mx0[l] : maxValue;
+			}
+		}
+		for (; i < n; ++i)
+		{
+			minValue = data[i] < minValue ? data[i] : minValue;
+			maxValue = data[i] > maxValue ? data[i] : maxValue;
+		}
+	}
+
+	void resetBlock(){
+		blockFill = 0;
+		blockMin = numeric_limits<sample_t>::max();
+		blockMax = numeric_limits<sample_t>::lowest();
+	}
+
+	void pushBlock(){
+		for (Level& level : levels)
+		{
+			if(level.pending == 0){
+				level.curMin = blockMin;
+				level.curMax = blockMax;
+			}
+			else {
+				level.curMin = min(level.curMin, blockMin);
+				level.curMax = max(level.curMax, blockMax);
+			}
+			level.pending += blockFill;
+			if(level.pending == level.samplesPerPoint){
+				level.mins.push_back(level.curMin);
+				level.maxs.push_back(level.curMax);
+				level.pending = 0;
+			}
+		}
+		resetBlock();
+	}
+
+	static void addDirect(Level& level, const sample_t* data, int n){
+		int spp = level.samplesPerPoint;
+		// celé body bez rozpracovaného zbytku rovnou do výsledku
+		if(level.pending == 0 && n >= spp){
+			int points = n/spp;
+			size_t first = level.mins.size();
+			level.mins.resize(first + points);
+			level.maxs.resize(first + points);
+			for (int p = 0; p < points; ++p)
+			{
+				sample_t mn = numeric_limits<sample_t>::max();
+				sample_t mx = numeric_limits<sample_t>::lowest();
+				reduce(data + (size_t)p*spp, spp, mn, mx);
+				level.mins[first+p] = mn;
+				level.maxs[first+p] = mx;
+			}
+			data += (size_t)points*spp;
+			n -= points*spp;
+		}
+		while(n > 0){
+			if(level.pending == 0){
+				level.curMin = numeric_limits<sample_t>::max();
+				level.curMax = numeric_limits<sample_t>::lowest();
+			}
+			int count = min(n, spp - level.pending);
+			reduce(data, count, level.curMin, level.curMax);
+			level.pending += count;
+			data += count;
+			n -= count;
+			if(level.pending == spp){
+				level.mins.push_back(level.curMin);
+				level.maxs.push_back(level.curMax);
+				level.pending = 0;
+			}
+		}
+	}
+
+	static void finishLevel(Level& level){
+		if(level.pending > 0){
+			level.mins.push_back(level.curMin);
+			level.maxs.push_back(level.curMax);
+			level.pending = 0;
+		}
+	}
+
+public:
+	void addLevel(int samplesPerPoint){
+		if(samplesPerPoint <= 0)
+			throw invalid_argument("invalid envelope resolution");
+		if(hasLevel(samplesPerPoint))
+			return;
+		Level level;
+		level.samplesPerPoint = samplesPerPoint;
+		if(samplesPerPoint % pyramidBlock == 0)
+			levels.push_back(level);
+		else
+			directLevels.push_back(level);
+		resetBlock();
+	}
+
+	void addSamples(const sample_t* data, int n){
+		for (Level& level : directLevels)
+			addDirect(level, data, n);
+		if(levels.empty())
+			return;
+		while(n > 0){
+			int count = min(n, pyramidBlock - blockFill);
+			reduce(data, count, blockMin, blockMax);
+			blockFill += count;
+			data += count;
+			n -= count;
+			if(blockFill == pyramidBlock)
+				pushBlock();
+		}
+	}
+
+	// dokončí neúplné body na konci nahrávky
+	void finish(){
+		if(blockFill > 0)
+			pushBlock();
+		for (Level& level : levels)
+			finishLevel(level);
+		for (Level& level : directLevels)
+			finishLevel(level);
+	}
+
+	bool hasLevel(int samplesPerPoint) const {
+		for (const vector<Level>* group : {&levels, &directLevels})
+		{
+			for (const Level& level : *group)
+			{
+				if(level.samplesPerPoint == samplesPerPoint)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	const Level& getLevel(int samplesPerPoint) const {
+		for (const vector<Level>* group : {&levels, &directLevels})
+		{
+			for (const Level& level : *group)
+			{
+				if(level.samplesPerPoint == samplesPerPoint)
+					return level;
+			}
+		}
+		throw invalid_argument("missing envelope resolution");
+	}
+
+	// formát souboru (little endian):
+	//   "SPKF", uint32 verze (1), uint32 sample rate, uint32 počet úrovní
+	//   pro každou úroveň: uint32 samplů na bod, uint64 počet bodů,
+	//   následně body jako dvojice float32 (min, max)
+	void write(const string& filename, int samplerate, const vector<int>& resolutions) const {
+		ofstream out(filename, ios::binary);
+		if(!out)
+			throw runtime_error("cannot open peak file");
+
+		auto put32 = [&out](uint32_t value){ out.write((const char*)&value, sizeof(value)); };
+		auto put64 = [&out](uint64_t value){ out.write((const char*)&value, sizeof(value)); };
+
+		out.write("SPKF", 4);
+		put32(1);
+		put32(samplerate);
+		put32(resolutions.size());
+		vector<float> points;
+		for (int resolution : resolutions)
+		{
+			const Level& level = getLevel(resolution);
+			put32(level.samplesPerPoint);
+			put64(level.mins.size());
+			points.resize(level.mins.size()*2);
+			for (size_t i = 0; i < level.mins.size(); ++i)
+			{
+				points[i*2] = level.mins[i];
+				points[i*2+1] = level.maxs[i];
+			}
+			out.write((const char*)points.data(), points.size()*sizeof(float));
+		}
+		if(!out)
+			throw runtime_error("cannot write peak file");
+	}
+};
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <cmath>
+#include <memory>
+#include <string>
+#include "sample_type.hpp"
 
 using namespace std;
 
@@ -12,7 +15,12 @@ protected:
 	int windowSize = 0;
 public:
 	virtual ~WindowFunction() {};
-	virtual double apply(double value, int i) = 0;
+	virtual sample_t apply(sample_t value, int i) const = 0;
+	// koeficienty a0, a1, ... periodické varianty w(n) = a0 - a1*cos(2πn/N) + a2*cos(4πn/N) - ...
+	// prázdné, pokud window funkci nelze takto vyjádřit
+	virtual vector<double> getCosineTerms() const {
+		return {};
+	}
 	virtual void setWindowSize(int windowsize){
 		windowSize = windowsize;
 	};
@@ -20,7 +28,10 @@ public:
 
 class RectangleWindowFunction : public WindowFunction
 {
-	virtual double apply(double value, int i) {
+	virtual vector<double> getCosineTerms() const {
+		return {1};
+	}
+	virtual sample_t apply(sample_t value, int i) const {
 		return value;
 	}
 };
@@ -28,7 +39,7 @@ class RectangleWindowFunction : public WindowFunction
 class PrecomputedWindowFunction : public WindowFunction
 {
 protected:
-	vector<double> window;
+	vector<sample_t> window;
 public:
 	virtual void setWindowSize(int windowsize){
 		windowSize = windowsize;
@@ -39,7 +50,7 @@ public:
 		}
 	};
 	virtual double get(int i) = 0;
-	virtual double apply(double value, int i) {
+	virtual sample_t apply(sample_t value, int i) const {
 		return value*window[i];
 	}
 };
@@ -50,6 +61,9 @@ class HannWindowFunction : public PrecomputedWindowFunction
 	virtual double get(int i){
 		return 0.5*(1-cos(2*M_PI*i/(windowSize-1)));
 	}
+	virtual vector<double> getCosineTerms() const {
+		return {0.5, 0.5};
+	}
 };
 
 class HammingWindowFunction : public PrecomputedWindowFunction
@@ -57,17 +71,36 @@ class HammingWindowFunction : public PrecomputedWindowFunction
 	virtual double get(int i){
 		return 0.54 - 0.46 * cos(2*M_PI*i/(windowSize-1));
 	}
+	virtual vector<double> getCosineTerms() const {
+		return {0.54, 0.46};
+	}
 };
 
 class BlackmannWindowFunction : public PrecomputedWindowFunction
 {
+	const double a0 = 7938.0/18608.0;
+	const double a1 = 9240.0/18608.0;
+	const double a2 = 1430.0/18608.0;
+	// double a0 = 0.42, a1 = 0.5, a2 = 0.08;
 	virtual double get(int i){
-		double a0 = 7938.0/18608.0;
-		double a1 = 9240.0/18608.0;
-		double a2 = 1430.0/18608.0;
-		// double a0 = 0.42, a1 = 0.5, a2 = 0.08;
 		return a0 - a1 * cos(2*M_PI*i/(windowSize-1)) + a2 * cos(4*M_PI*i/(windowSize-1));
 	}
+	virtual vector<double> getCosineTerms() const {
+		return {a0, a1, a2};
+	}
 };
 
+// vytvoří window funkci podle názvu z příkazové řádky, pro neznámý název vrací nullptr
+inline unique_ptr<WindowFunction> makeWindowFunction(const string& name){
+	if(name == "rect")
+		return make_unique<RectangleWindowFunction>();
+	else if(name == "hann")
+		return make_unique<HannWindowFunction>();
+	else if(name == "hamming")
+		return make_unique<HammingWindowFunction>();
+	else if(name == "blackmann")
+		return make_unique<BlackmannWindowFunction>();
+	return nullptr;
+}
+
 #endif
\ No newline at end of file